@@ -16,6 +16,8 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/vec2.hpp>
 
+#include "TextureManager.h"
+
 #ifdef __EMSCRIPTEN__
     #include <SDL2/SDL_opengles2.h>
     #include <emscripten.h>
@@ -38,12 +40,18 @@ static const std::string BULLET_SHADER_VERT = "resources/shader/BulletV3.vert";
 static const std::string BULLET_SHADER_FRAG = "resources/shader/BulletV3.frag";
 #endif
 
+static const std::string SPRITE_TEXTURE = "resources/texture/example.png";
+static const std::string FONT_TEXTURE   = "resources/font/Roboto-Bold.ttf";
+
+size_t textureBudgetBytes      = 32 * 1024 * 1024;
+size_t maxTextureLoadsPerFrame = 2;
+Uint32 startupTextureTimeout   = 1000;
+std::unique_ptr<TextureManager> textureManager;
+
 bool running = true;
 SDL_Window* window;
 SDL_GLContext context;
-unsigned int textureId     = 0;
-unsigned int textureWidth  = 0;
-unsigned int textureHeight = 0;
+TextureHandle spriteTexture;
 glm::vec2 texturePosition {WINDOW_WIDTH / 2.0f, WINDOW_HEIGHT - 200.0f};
 float textureScale             = 5.0f;
 unsigned int vertexArray       = 0;
@@ -57,10 +65,7 @@ GLuint bulletVertexShader      = 0;
 GLuint bulletFragShader        = 0;
 Uint32 tickCount               = 0;
 Mix_Music* music               = nullptr;
-unsigned int fontTextureId     = 0;
-unsigned int fontTextureWidth  = 0;
-unsigned int fontTextureHeight = 0;
-SDL_Texture* fontTexture       = nullptr;
+TextureHandle fontTexture;
 glm::vec2 fontPosition {WINDOW_WIDTH / 2.0f, 0.0f};
 std::vector<std::pair<glm::vec2, glm::vec2>> bulletPositions;
 
@@ -191,7 +196,7 @@ bool loadShaders(const std::string& vertName,
     return true;
 }
 
-bool loadTexture(const std::string& fileName)
+bool loadTexture(const std::string& fileName, TextureImage& outImage)
 {
     FILE* pngFile = fopen(fileName.c_str(), "rb");
     if (!pngFile)
@@ -204,6 +209,7 @@ bool loadTexture(const std::string& fileName)
     if (!pngStruct)
     {
         SDL_Log("Failed to create PNG structure %s", fileName.c_str());
+        fclose(pngFile);
         return false;
     }
 
@@ -213,11 +219,14 @@ bool loadTexture(const std::string& fileName)
         SDL_Log("Failed to create PNG info structure %s", fileName.c_str());
         png_destroy_read_struct(&pngStruct, nullptr, nullptr);
         pngStruct = nullptr;
+        fclose(pngFile);
         return false;
     }
 
     if (setjmp(png_jmpbuf(pngStruct)))
     {
+        png_destroy_read_struct(&pngStruct, &pngInfo, nullptr);
+        fclose(pngFile);
         return false;
     }
 
@@ -231,9 +240,6 @@ bool loadTexture(const std::string& fileName)
     auto colorType  = png_get_color_type(pngStruct, pngInfo);
     auto numChannel = png_get_channels(pngStruct, pngInfo);
 
-    textureWidth  = (unsigned int)width;
-    textureHeight = (unsigned int)height;
-
     // prepare storage
     auto pixels  = std::make_unique<png_byte[]>(height * rowLen);
     auto rowPtrs = std::make_unique<png_bytep[]>(height);
@@ -245,30 +251,84 @@ bool loadTexture(const std::string& fileName)
     // read pixels
     png_read_image(pngStruct, rowPtrs.get());
 
-    auto image = std::make_unique<unsigned char[]>(numChannel * width * height);
+    outImage.pixels.resize(numChannel * width * height);
     for (int i = 0; i < height; ++i)
     {
         for (int j = 0; j < numChannel * width; ++j)
         {
-            image[i * numChannel * width + j] = rowPtrs[i][j];
+            outImage.pixels[i * numChannel * width + j] = rowPtrs[i][j];
         }
     }
 
     png_destroy_read_struct(&pngStruct, &pngInfo, nullptr);
     fclose(pngFile);
 
-    int format = colorType == PNG_COLOR_TYPE_RGB_ALPHA ? GL_RGBA : GL_RGB;
+    outImage.width    = (unsigned int)width;
+    outImage.height   = (unsigned int)height;
+    outImage.mipCount = 1;
+    outImage.format   = colorType == PNG_COLOR_TYPE_RGB_ALPHA ? TextureFormat::RGBA
+                                                              : TextureFormat::RGB;
+    outImage.filter   = TextureFilter::Linear;
+
+    return true;
+}
+
+unsigned int uploadTexture(const TextureImage& image)
+{
+    int format = image.format == TextureFormat::RGBA ? GL_RGBA : GL_RGB;
 
+    unsigned int textureId = 0;
     glGenTextures(1, &textureId);
     glBindTexture(GL_TEXTURE_2D, textureId);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, image.get());
+    glTexImage2D(GL_TEXTURE_2D,
+                 0,
+                 format,
+                 image.width,
+                 image.height,
+                 0,
+                 format,
+                 GL_UNSIGNED_BYTE,
+                 image.pixels.data());
 
-    // Enable bilinear filtering
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // Enable bilinear filtering, or nearest for pixel exact images such as text
+    int filter = image.filter == TextureFilter::Linear ? GL_LINEAR : GL_NEAREST;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
 
-    return true;
+    if (image.clampToEdge)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    return textureId;
+}
+
+void initializeTextures()
+{
+    TextureBackend backend;
+    backend.upload  = uploadTexture;
+    backend.destroy = [](unsigned int textureId)
+    {
+        glDeleteTextures(1, &textureId);
+    };
+    backend.bind = [](unsigned int textureId)
+    {
+        glBindTexture(GL_TEXTURE_2D, textureId);
+    };
+
+#ifdef __EMSCRIPTEN__
+    // The web build has no worker threads, so textures are decoded synchronously on the main thread
+    bool asyncDecode = false;
+#else
+    bool asyncDecode = true;
+#endif
+
+    textureManager = std::make_unique<TextureManager>(backend,
+                                                      textureBudgetBytes,
+                                                      maxTextureLoadsPerFrame,
+                                                      asyncDecode);
 }
 
 void quit()
@@ -280,8 +340,9 @@ void quit()
     glDeleteProgram(bulletShaderProgram);
     glDeleteShader(bulletVertexShader);
     glDeleteShader(bulletFragShader);
-    glDeleteTextures(1, &textureId);
-    glDeleteTextures(1, &fontTextureId);
+    textureManager->release(spriteTexture);
+    textureManager->release(fontTexture);
+    textureManager->clear();
     // Delete vertex array
     glDeleteBuffers(1, &vertexBuffer);
     glDeleteBuffers(1, &indexBuffer);
@@ -314,11 +375,11 @@ void processInput(const Uint8* keyboardState, const float deltaTime)
         texturePosition.y += speed;
     }
 
-    float diffX       = textureWidth / 2.0f * textureScale / 2.0f;
+    float diffX       = spriteTexture->getWidth() / 2.0f * textureScale / 2.0f;
     texturePosition.x = std::max(texturePosition.x, diffX);
     texturePosition.x = std::min(texturePosition.x, WINDOW_WIDTH - diffX);
 
-    float diffY       = textureHeight / 2.0f * textureScale / 2.0f;
+    float diffY       = spriteTexture->getHeight() / 2.0f * textureScale / 2.0f;
     texturePosition.y = std::max(texturePosition.y, diffY);
     texturePosition.y = std::min(texturePosition.y, WINDOW_HEIGHT - diffY);
 }
@@ -367,6 +428,7 @@ void mainloop()
 
     processInput(state, deltaTime);
     updateBullets();
+    textureManager->update();
 
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);  // set the clear color to blue
     glClear(GL_COLOR_BUFFER_BIT);          // Clear the color buffer
@@ -396,22 +458,30 @@ void mainloop()
     GLuint locationIdWindow = glGetUniformLocation(shaderProgram, "uWindowSize");
     glUniform2f(locationIdWindow, (GLfloat)WINDOW_WIDTH, (GLfloat)WINDOW_HEIGHT);
     GLuint locationIdTexture = glGetUniformLocation(shaderProgram, "uTextureSize");
-    glUniform2f(locationIdTexture, (GLfloat)textureWidth, (GLfloat)textureHeight);
+    glUniform2f(locationIdTexture,
+                (GLfloat)spriteTexture->getWidth(),
+                (GLfloat)spriteTexture->getHeight());
     GLuint locationIdTexturePos = glGetUniformLocation(shaderProgram, "uTexturePosition");
     glUniform2fv(locationIdTexturePos, 1, glm::value_ptr(texturePosition));
     GLuint locationIdTextureScale = glGetUniformLocation(shaderProgram, "uTextureScale");
     glUniform1f(locationIdTextureScale, (GLfloat)textureScale);
 
-    glBindTexture(GL_TEXTURE_2D, textureId);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+    if (textureManager->bind(spriteTexture))
+    {
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+    }
 
     // Draw Text
-    glUniform2f(locationIdTexture, (GLfloat)fontTextureWidth, (GLfloat)fontTextureHeight);
+    glUniform2f(locationIdTexture,
+                (GLfloat)fontTexture->getWidth(),
+                (GLfloat)fontTexture->getHeight());
     glUniform2fv(locationIdTexturePos, 1, glm::value_ptr(fontPosition));
     glUniform1f(locationIdTextureScale, 3.0f);
 
-    glBindTexture(GL_TEXTURE_2D, fontTextureId);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+    if (textureManager->bind(fontTexture))
+    {
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+    }
 
     // swap the buffers
     SDL_GL_SwapWindow(window);
@@ -432,14 +502,13 @@ int nextPowerOfTwo(int value)
     return power;
 }
 
-void initializeFont()
+bool loadFontTexture(const std::string& fileName, TextureImage& outImage)
 {
-    TTF_Init();
-    TTF_Font* font = TTF_OpenFont("resources/font/Roboto-Bold.ttf", 28);
+    TTF_Font* font = TTF_OpenFont(fileName.c_str(), 28);
     if (!font)
     {
         SDL_Log("Failed to open font");
-        return;
+        return false;
     }
 
     SDL_Color color {255, 255, 255, 255};
@@ -447,7 +516,8 @@ void initializeFont()
     if (!surface)
     {
         SDL_Log("Unable to render text surface! SDL_ttf error: %s", TTF_GetError());
-        return;
+        TTF_CloseFont(font);
+        return false;
     }
 
     // Convert surface from 8 to 32 bit for GL
@@ -468,48 +538,44 @@ void initializeFont()
     SDL_BlitSurface(textureImage, NULL, texture, &destRect);
 
     // Determine GL texture format
-    GLint format;
     if (texture->format->BitsPerPixel == 24)
     {
-        format = GL_RGB;
+        outImage.format = TextureFormat::RGB;
     }
     else if (texture->format->BitsPerPixel == 32)
     {
-        format = GL_RGBA;
+        outImage.format = TextureFormat::RGBA;
     }
     else
     {
         SDL_Log("Invalid font texture format");
-        return;
+        SDL_FreeSurface(textureImage);
+        SDL_FreeSurface(texture);
+        TTF_CloseFont(font);
+        return false;
     }
 
-    // Generate a GL texture object
-    glGenTextures(1, &fontTextureId);
-    glBindTexture(GL_TEXTURE_2D, fontTextureId);
-
-    // Copy SDL surface image to GL texture
-    glTexImage2D(GL_TEXTURE_2D,
-                 0,
-                 format,
-                 texture->w,
-                 texture->h,
-                 0,
-                 format,
-                 GL_UNSIGNED_BYTE,
-                 texture->pixels);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-    fontTextureWidth  = texture->w;
-    fontTextureHeight = texture->h;
+    // Copy SDL surface image for the GL upload
+    auto* pixels = static_cast<unsigned char*>(texture->pixels);
+    auto size    = texture->w * texture->h * texture->format->BytesPerPixel;
+    outImage.pixels.assign(pixels, pixels + size);
+    outImage.width       = texture->w;
+    outImage.height      = texture->h;
+    outImage.mipCount    = 1;
+    outImage.filter      = TextureFilter::Nearest;
+    outImage.clampToEdge = true;
 
     SDL_FreeSurface(textureImage);
     SDL_FreeSurface(texture);
     TTF_CloseFont(font);
+    return true;
+}
+
+void initializeFont()
+{
+    TTF_Init();
+    // SDL_ttf shares one FreeType library and is not thread-safe, so render text on this thread
+    fontTexture = textureManager->acquire(FONT_TEXTURE, loadFontTexture, false);
 }
 
 void initializeBullets()
@@ -604,13 +670,29 @@ int main(int argc, char* argv[])
         return EXIT_FAILURE;
     }
 
-    if (!loadTexture("resources/texture/example.png"))
+    initializeTextures();
+    spriteTexture = textureManager->acquire(SPRITE_TEXTURE, loadTexture);
+    initializeFont();
+
+    // Load the startup textures before the first frame; later requests load in the background.
+    // Stop early on a missing file instead of waiting for every retry.
+    auto isSettled = [](const TextureHandle& texture)
+    {
+        return texture->isResident() || texture->getState() == TextureState::Failed;
+    };
+    Uint32 startupTicks = SDL_GetTicks();
+    do
+    {
+        textureManager->update();
+        SDL_Delay(1);
+    } while (!(isSettled(spriteTexture) && isSettled(fontTexture))
+             && !SDL_TICKS_PASSED(SDL_GetTicks(), startupTicks + startupTextureTimeout));
+
+    if (!spriteTexture->isResident())
     {
         SDL_Log("Failed to load texture");
         return EXIT_FAILURE;
     }
-
-    initializeFont();
     initializeBullets();
 
     Mix_Init(MIX_INIT_MP3);
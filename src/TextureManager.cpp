@@ -0,0 +1,414 @@
+#include "TextureManager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+namespace
+{
+    // A failed decode is retried after 30, 60, 120, ... frames before giving up
+    const unsigned int MAX_DECODE_RETRIES = 5;
+    const Uint32 RETRY_DELAY_FRAMES       = 30;
+
+    std::optional<TextureImage> decodeTexture(const TextureDecoder& decoder,
+                                              const std::string& path)
+    {
+        TextureImage image;
+        if (!decoder(path, image))
+        {
+            return std::nullopt;
+        }
+        return image;
+    }
+}  // namespace
+
+size_t estimateTextureSize(unsigned int width,
+                           unsigned int height,
+                           unsigned int mipCount,
+                           TextureFormat format)
+{
+    size_t bytesPerPixel = format == TextureFormat::RGB ? 3 : 4;
+    size_t size          = 0;
+    for (unsigned int level = 0; level < std::max(mipCount, 1u); ++level)
+    {
+        size_t levelWidth  = std::max(width >> level, 1u);
+        size_t levelHeight = std::max(height >> level, 1u);
+        size += levelWidth * levelHeight * bytesPerPixel;
+    }
+    return size;
+}
+
+Texture::Texture(const std::string& path, TextureDecoder decoder, bool asyncDecode) :
+    mPath(path),
+    mDecoder(std::move(decoder)),
+    mAsyncDecode(asyncDecode)
+{
+}
+
+const std::string& Texture::getPath() const
+{
+    return mPath;
+}
+
+unsigned int Texture::getWidth() const
+{
+    return mWidth;
+}
+
+unsigned int Texture::getHeight() const
+{
+    return mHeight;
+}
+
+TextureState Texture::getState() const
+{
+    return mState;
+}
+
+bool Texture::isResident() const
+{
+    return mState == TextureState::Resident;
+}
+
+TextureManager::TextureManager(TextureBackend backend,
+                               size_t budgetBytes,
+                               size_t maxLoadsPerFrame,
+                               bool asyncDecode) :
+    mBackend(std::move(backend)),
+    mMaxLoadsPerFrame(std::max<size_t>(maxLoadsPerFrame, 1)),
+    mAsyncDecode(asyncDecode)
+{
+    mStats.budgetBytes = budgetBytes;
+}
+
+TextureManager::~TextureManager()
+{
+    clear();
+}
+
+TextureHandle TextureManager::acquire(const std::string& path,
+                                      TextureDecoder decoder,
+                                      bool asyncDecode)
+{
+    auto iter = mTextures.find(path);
+    if (iter == mTextures.end())
+    {
+        auto texture = std::make_shared<Texture>(path, std::move(decoder), asyncDecode);
+        iter         = mTextures.emplace(path, texture).first;
+    }
+
+    auto& texture           = iter->second;
+    texture->mLastUsedFrame = mFrame;
+    if (texture->mState == TextureState::Failed)
+    {
+        // An explicit request gets a fresh set of retries, e.g. once the file has been fetched
+        texture->mFailCount = 0;
+        texture->mState     = TextureState::Unloaded;
+    }
+    if (texture->mState == TextureState::Unloaded)
+    {
+        enqueue(texture);
+    }
+    return texture;
+}
+
+void TextureManager::release(TextureHandle& texture)
+{
+    texture.reset();
+}
+
+bool TextureManager::bind(const TextureHandle& texture)
+{
+    auto* entry = find(texture);
+    if (!entry)
+    {
+        return false;
+    }
+
+    auto& owned           = *entry;
+    owned->mLastUsedFrame = mFrame;
+    if (owned->mState != TextureState::Resident)
+    {
+        if (owned->mState == TextureState::Unloaded)
+        {
+            enqueue(owned);
+        }
+        return false;
+    }
+
+    mBackend.bind(owned->mId);
+    return true;
+}
+
+void TextureManager::update()
+{
+    mFrame += 1;
+    mStats.loadsThisFrame  = 0;
+    mStats.evictsThisFrame = 0;
+
+    collectDecodes();
+    dropUnreferenced();
+    startDecodes();
+    uploadDecoded();
+    evict(0);
+
+    std::erase_if(mPending,
+                  [](const TextureEntry& texture)
+                  {
+                      return texture->mState == TextureState::Resident
+                          || texture->mState == TextureState::Unloaded
+                          || texture->mState == TextureState::Failed;
+                  });
+
+    mStats.pendingCount = mPending.size();
+    mStats.failedCount  = std::count_if(mTextures.begin(),
+                                       mTextures.end(),
+                                       [](const auto& entry)
+                                       {
+                                           return entry.second->mState == TextureState::Failed;
+                                       });
+
+    if (mStats.loadsThisFrame > 0 || mStats.evictsThisFrame > 0)
+    {
+        SDL_Log("Textures: %zu resident, %zu / %zu bytes, %zu pending, %zu failed, %zu loaded, "
+                "%zu evicted",
+                mStats.residentCount,
+                mStats.residentBytes,
+                mStats.budgetBytes,
+                mStats.pendingCount,
+                mStats.failedCount,
+                mStats.loadsThisFrame,
+                mStats.evictsThisFrame);
+    }
+}
+
+void TextureManager::clear()
+{
+    for (auto& [path, texture] : mTextures)
+    {
+        if (texture->mState == TextureState::Resident)
+        {
+            unload(*texture);
+        }
+    }
+
+    // Destroying the futures waits for decodes still running on worker threads
+    mPending.clear();
+    mTextures.clear();
+}
+
+void TextureManager::setBudget(size_t budgetBytes)
+{
+    mStats.budgetBytes = budgetBytes;
+}
+
+const TextureStats& TextureManager::getStats() const
+{
+    return mStats;
+}
+
+TextureManager::TextureEntry* TextureManager::find(const TextureHandle& texture)
+{
+    auto iter = mTextures.find(texture->getPath());
+    if (iter == mTextures.end() || iter->second != texture)
+    {
+        return nullptr;
+    }
+    return &iter->second;
+}
+
+void TextureManager::enqueue(const TextureEntry& texture)
+{
+    texture->mState      = TextureState::Queued;
+    texture->mRetryFrame = mFrame;
+    mPending.push_back(texture);
+}
+
+// Stop loading textures whose handles were all released before they became resident
+void TextureManager::dropUnreferenced()
+{
+    for (auto& texture : mPending)
+    {
+        // One reference is held by mTextures and one by mPending
+        bool unreferenced = texture.use_count() <= 2;
+        if (!unreferenced
+            || (texture->mState != TextureState::Queued
+                && texture->mState != TextureState::Decoded))
+        {
+            continue;
+        }
+
+        // A texture still decoding is dropped once collectDecodes() has its pixels
+        texture->mImage = {};
+        texture->mState = TextureState::Unloaded;
+    }
+}
+
+void TextureManager::retry(Texture& texture)
+{
+    texture.mFailCount += 1;
+    if (texture.mFailCount > MAX_DECODE_RETRIES)
+    {
+        SDL_Log("Failed to load texture %s, giving up", texture.mPath.c_str());
+        texture.mState = TextureState::Failed;
+        return;
+    }
+
+    Uint32 delay = RETRY_DELAY_FRAMES << (texture.mFailCount - 1);
+    SDL_Log("Failed to load texture %s, retrying in %u frames", texture.mPath.c_str(), delay);
+    texture.mState      = TextureState::Queued;
+    texture.mRetryFrame = mFrame + delay;
+}
+
+void TextureManager::stage(Texture& texture, std::optional<TextureImage> image)
+{
+    if (!image)
+    {
+        retry(texture);
+        return;
+    }
+    texture.mImage  = std::move(*image);
+    texture.mWidth  = texture.mImage.width;
+    texture.mHeight = texture.mImage.height;
+    texture.mState  = TextureState::Decoded;
+}
+
+void TextureManager::collectDecodes()
+{
+    for (auto& texture : mPending)
+    {
+        if (texture->mState != TextureState::Decoding
+            || texture->mDecoding.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            continue;
+        }
+        stage(*texture, texture->mDecoding.get());
+    }
+}
+
+void TextureManager::startDecodes()
+{
+    // Decoded pixels waiting for room in the budget count too, so a blocked upload stops new
+    // decodes instead of piling images up in memory
+    size_t inFlight = std::count_if(mPending.begin(),
+                                    mPending.end(),
+                                    [](const TextureEntry& texture)
+                                    {
+                                        return texture->mState == TextureState::Decoding
+                                            || texture->mState == TextureState::Decoded;
+                                    });
+
+    for (auto& texture : mPending)
+    {
+        if (inFlight >= mMaxLoadsPerFrame)
+        {
+            break;
+        }
+        if (texture->mState != TextureState::Queued || texture->mRetryFrame > mFrame)
+        {
+            continue;
+        }
+
+        inFlight += 1;
+        if (mAsyncDecode && texture->mAsyncDecode)
+        {
+            texture->mState    = TextureState::Decoding;
+            texture->mDecoding = std::async(std::launch::async,
+                                            decodeTexture,
+                                            texture->mDecoder,
+                                            texture->mPath);
+            continue;
+        }
+        stage(*texture, decodeTexture(texture->mDecoder, texture->mPath));
+    }
+}
+
+void TextureManager::uploadDecoded()
+{
+    for (auto& texture : mPending)
+    {
+        if (mStats.loadsThisFrame >= mMaxLoadsPerFrame)
+        {
+            break;
+        }
+        if (texture->mState != TextureState::Decoded)
+        {
+            continue;
+        }
+
+        auto& image = texture->mImage;
+        size_t size = estimateTextureSize(image.width, image.height, image.mipCount, image.format);
+        if (size > mStats.budgetBytes)
+        {
+            SDL_Log("Texture %s (%zu bytes) is larger than the budget (%zu bytes)",
+                    texture->mPath.c_str(),
+                    size,
+                    mStats.budgetBytes);
+            texture->mImage = {};
+            texture->mState = TextureState::Failed;
+            continue;
+        }
+
+        // Make room before allocating; wait while referenced textures hold the budget
+        if (!evict(size))
+        {
+            continue;
+        }
+
+        unsigned int id = mBackend.upload(image);
+        texture->mImage = {};
+        if (id == 0)
+        {
+            retry(*texture);
+            continue;
+        }
+
+        texture->mId            = id;
+        texture->mSizeInBytes   = size;
+        texture->mLastUsedFrame = mFrame;
+        texture->mState         = TextureState::Resident;
+        mStats.residentCount += 1;
+        mStats.residentBytes += size;
+        mStats.loadsThisFrame += 1;
+    }
+}
+
+// Evict least recently used textures nobody holds a handle to until `requiredBytes` fits the budget
+bool TextureManager::evict(size_t requiredBytes)
+{
+    while (mStats.residentBytes + requiredBytes > mStats.budgetBytes)
+    {
+        Texture* oldest = nullptr;
+        for (auto& [path, texture] : mTextures)
+        {
+            if (texture->mState != TextureState::Resident || texture.use_count() > 1)
+            {
+                continue;
+            }
+            if (!oldest || texture->mLastUsedFrame < oldest->mLastUsedFrame)
+            {
+                oldest = texture.get();
+            }
+        }
+
+        if (!oldest)
+        {
+            return false;
+        }
+
+        SDL_Log("Evict texture %s (%zu bytes)", oldest->mPath.c_str(), oldest->mSizeInBytes);
+        unload(*oldest);
+        mStats.evictsThisFrame += 1;
+    }
+    return true;
+}
+
+void TextureManager::unload(Texture& texture)
+{
+    mBackend.destroy(texture.mId);
+    mStats.residentCount -= 1;
+    mStats.residentBytes -= texture.mSizeInBytes;
+    texture.mId          = 0;
+    texture.mSizeInBytes = 0;
+    texture.mState       = TextureState::Unloaded;
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class TextureFormat
+{
+    RGB,
+    RGBA
+};
+
+enum class TextureFilter
+{
+    Linear,
+    Nearest
+};
+
+enum class TextureState
+{
+    Unloaded,  // Not in GPU memory and not requested
+    Queued,    // Waiting for a decode slot (or for a retry after a failed decode)
+    Decoding,  // Decoding on a worker thread
+    Decoded,   // Pixels are ready and wait for room in the budget
+    Resident,  // Uploaded to GPU memory
+    Failed     // Gave up; a new acquire() tries again
+};
+
+// CPU side pixels produced by a decoder; built without touching GL so it can run on a worker thread
+struct TextureImage
+{
+    unsigned int width    = 0;
+    unsigned int height   = 0;
+    unsigned int mipCount = 1;
+    TextureFormat format  = TextureFormat::RGBA;
+    TextureFilter filter  = TextureFilter::Linear;
+    bool clampToEdge      = false;
+    std::vector<unsigned char> pixels;
+};
+
+using TextureDecoder = std::function<bool(const std::string& path, TextureImage& outImage)>;
+
+// GL side of the manager; upload returns 0 on failure
+struct TextureBackend
+{
+    std::function<unsigned int(const TextureImage&)> upload;
+    std::function<void(unsigned int)> destroy;
+    std::function<void(unsigned int)> bind;
+};
+
+class Texture
+{
+public:
+    Texture(const std::string& path, TextureDecoder decoder, bool asyncDecode);
+
+    const std::string& getPath() const;
+    unsigned int getWidth() const;
+    unsigned int getHeight() const;
+    TextureState getState() const;
+    bool isResident() const;
+
+private:
+    // Bookkeeping is owned by TextureManager; handles only get the read-only view above
+    friend class TextureManager;
+
+    std::string mPath;
+    TextureDecoder mDecoder;
+    bool mAsyncDecode;
+    TextureState mState     = TextureState::Unloaded;
+    unsigned int mId        = 0;
+    unsigned int mWidth     = 0;
+    unsigned int mHeight    = 0;
+    size_t mSizeInBytes     = 0;
+    Uint32 mLastUsedFrame   = 0;
+    unsigned int mFailCount = 0;
+    Uint32 mRetryFrame      = 0;
+    TextureImage mImage;
+    std::future<std::optional<TextureImage>> mDecoding;
+};
+
+// Callers keep a texture alive by holding its handle; release() it to make it evictable
+using TextureHandle = std::shared_ptr<const Texture>;
+
+struct TextureStats
+{
+    size_t residentCount   = 0;
+    size_t residentBytes   = 0;
+    size_t budgetBytes     = 0;
+    size_t pendingCount    = 0;
+    size_t failedCount     = 0;
+    size_t loadsThisFrame  = 0;
+    size_t evictsThisFrame = 0;
+};
+
+// Estimated GPU memory of a texture: bytes per pixel x width x height, summed over the mip chain
+size_t estimateTextureSize(unsigned int width,
+                           unsigned int height,
+                           unsigned int mipCount,
+                           TextureFormat format);
+
+class TextureManager
+{
+public:
+    // `maxLoadsPerFrame` caps the uploads per update() and also the decodes in flight, i.e.
+    // textures being decoded or holding decoded pixels that wait for an upload
+    TextureManager(TextureBackend backend,
+                   size_t budgetBytes,
+                   size_t maxLoadsPerFrame,
+                   bool asyncDecode);
+    ~TextureManager();
+
+    TextureManager(const TextureManager&)            = delete;
+    TextureManager& operator=(const TextureManager&) = delete;
+
+    // Returns the texture keyed by `path`; it is decoded and uploaded by later update() calls.
+    // Pass `asyncDecode` false for decoders that must stay on the calling thread.
+    TextureHandle acquire(const std::string& path, TextureDecoder decoder, bool asyncDecode = true);
+    void release(TextureHandle& texture);
+
+    // Binds a resident texture; otherwise queues a reload and returns false so the draw is skipped
+    bool bind(const TextureHandle& texture);
+
+    // Call once per frame on the GL thread
+    void update();
+    void clear();
+
+    void setBudget(size_t budgetBytes);
+    const TextureStats& getStats() const;
+
+private:
+    using TextureEntry = std::shared_ptr<Texture>;
+
+    TextureEntry* find(const TextureHandle& texture);
+    void enqueue(const TextureEntry& texture);
+    void dropUnreferenced();
+    void retry(Texture& texture);
+    void stage(Texture& texture, std::optional<TextureImage> image);
+    void collectDecodes();
+    void startDecodes();
+    void uploadDecoded();
+    bool evict(size_t requiredBytes);
+    void unload(Texture& texture);
+
+    TextureBackend mBackend;
+    size_t mMaxLoadsPerFrame;
+    bool mAsyncDecode;
+    Uint32 mFrame = 0;
+    std::unordered_map<std::string, TextureEntry> mTextures;
+    std::vector<TextureEntry> mPending;
+    TextureStats mStats;
+};
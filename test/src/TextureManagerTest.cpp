@@ -0,0 +1,283 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <type_traits>
+
+#include "TextureManager.h"
+
+namespace
+{
+    // Every test texture is 4x4 RGBA, i.e. 64 bytes
+    const size_t TEXTURE_SIZE = 64;
+
+    bool decodeTestTexture(const std::string&, TextureImage& outImage)
+    {
+        outImage.width  = 4;
+        outImage.height = 4;
+        outImage.format = TextureFormat::RGBA;
+        outImage.pixels.resize(TEXTURE_SIZE);
+        return true;
+    }
+
+    class TextureManagerTest : public ::testing::Test
+    {
+    protected:
+        TextureManager createManager(size_t budgetBytes,
+                                     size_t maxLoadsPerFrame = 8,
+                                     bool asyncDecode        = false)
+        {
+            TextureBackend backend;
+            backend.upload = [this](const TextureImage&)
+            {
+                return ++lastId;
+            };
+            backend.destroy = [this](unsigned int textureId)
+            {
+                destroyed.push_back(textureId);
+            };
+            backend.bind = [](unsigned int) {};
+            return TextureManager(backend, budgetBytes, maxLoadsPerFrame, asyncDecode);
+        }
+
+        unsigned int lastId = 0;
+        std::vector<unsigned int> destroyed;
+    };
+}  // namespace
+
+TEST(EstimateTextureSize, Formats)
+{
+    EXPECT_EQ(estimateTextureSize(4, 4, 1, TextureFormat::RGBA), 64);
+    EXPECT_EQ(estimateTextureSize(4, 4, 1, TextureFormat::RGB), 48);
+}
+
+TEST(EstimateTextureSize, Mips)
+{
+    EXPECT_EQ(estimateTextureSize(4, 4, 3, TextureFormat::RGBA), (16 + 4 + 1) * 4);
+    EXPECT_EQ(estimateTextureSize(8, 2, 4, TextureFormat::RGB), (16 + 4 + 2 + 1) * 3);
+}
+
+TEST_F(TextureManagerTest, EvictsLeastRecentlyUsed)
+{
+    auto manager = createManager(TEXTURE_SIZE * 2);
+    auto first   = manager.acquire("first", decodeTestTexture);
+    manager.update();
+    auto second = manager.acquire("second", decodeTestTexture);
+    manager.update();
+
+    // Drawing `first` makes `second` the least recently used one
+    manager.update();
+    EXPECT_TRUE(manager.bind(first));
+    manager.release(first);
+    manager.release(second);
+
+    auto third = manager.acquire("third", decodeTestTexture);
+    manager.update();
+
+    EXPECT_EQ(third->getState(), TextureState::Resident);
+    EXPECT_EQ(manager.getStats().evictsThisFrame, 1);
+    EXPECT_EQ(manager.getStats().residentCount, 2);
+    EXPECT_EQ(destroyed, std::vector<unsigned int> {2});
+}
+
+TEST_F(TextureManagerTest, KeepsReferencedTextures)
+{
+    auto manager = createManager(TEXTURE_SIZE * 2);
+    auto first   = manager.acquire("first", decodeTestTexture);
+    auto second  = manager.acquire("second", decodeTestTexture);
+    manager.update();
+
+    // Both textures are referenced, so the third one waits instead of exceeding the budget
+    auto third = manager.acquire("third", decodeTestTexture);
+    manager.update();
+
+    EXPECT_EQ(third->getState(), TextureState::Decoded);
+    EXPECT_EQ(first->getState(), TextureState::Resident);
+    EXPECT_EQ(second->getState(), TextureState::Resident);
+    EXPECT_EQ(manager.getStats().evictsThisFrame, 0);
+    EXPECT_EQ(manager.getStats().pendingCount, 1);
+    EXPECT_LE(manager.getStats().residentBytes, manager.getStats().budgetBytes);
+
+    manager.release(first);
+    manager.update();
+
+    EXPECT_EQ(third->getState(), TextureState::Resident);
+    EXPECT_EQ(manager.getStats().evictsThisFrame, 1);
+    EXPECT_EQ(second->getState(), TextureState::Resident);
+}
+
+#ifndef __EMSCRIPTEN__
+// The web build has no threads, so std::async(std::launch::async) is unavailable there
+TEST_F(TextureManagerTest, DecodesOnWorkerThread)
+{
+    auto manager = createManager(TEXTURE_SIZE, 8, true);
+    auto texture = manager.acquire("texture", decodeTestTexture);
+
+    for (int i = 0; i < 1000 && texture->getState() != TextureState::Resident; ++i)
+    {
+        manager.update();
+        SDL_Delay(1);
+    }
+    EXPECT_EQ(texture->getState(), TextureState::Resident);
+    EXPECT_EQ(manager.getStats().residentBytes, TEXTURE_SIZE);
+}
+#endif
+
+TEST_F(TextureManagerTest, ReloadsEvictedTexture)
+{
+    auto manager  = createManager(TEXTURE_SIZE);
+    auto first    = manager.acquire("first", decodeTestTexture);
+    auto* texture = first.get();
+    manager.update();
+    manager.release(first);
+
+    auto second = manager.acquire("second", decodeTestTexture);
+    manager.update();
+    EXPECT_EQ(texture->getState(), TextureState::Unloaded);
+
+    // Acquiring an evicted texture again reloads it on demand once the budget has room
+    manager.release(second);
+    first = manager.acquire("first", decodeTestTexture);
+    EXPECT_EQ(first.get(), texture);
+    EXPECT_FALSE(manager.bind(first));
+    manager.update();
+
+    EXPECT_EQ(first->getState(), TextureState::Resident);
+    EXPECT_TRUE(manager.bind(first));
+}
+
+TEST_F(TextureManagerTest, BoundsDecodedBacklog)
+{
+    auto manager = createManager(TEXTURE_SIZE * 2, 2);
+    auto first   = manager.acquire("first", decodeTestTexture);
+    auto second  = manager.acquire("second", decodeTestTexture);
+    manager.update();
+
+    // The budget is held by referenced textures, so these can only be decoded, never uploaded
+    std::vector<TextureHandle> waiting;
+    for (int i = 0; i < 6; ++i)
+    {
+        waiting.push_back(manager.acquire("waiting" + std::to_string(i), decodeTestTexture));
+    }
+
+    for (int i = 0; i < 10; ++i)
+    {
+        manager.update();
+    }
+
+    auto decoded = std::count_if(waiting.begin(),
+                                 waiting.end(),
+                                 [](const TextureHandle& texture)
+                                 {
+                                     return texture->getState() == TextureState::Decoded;
+                                 });
+    EXPECT_EQ(decoded, 2);
+    EXPECT_EQ(manager.getStats().pendingCount, 6);
+    EXPECT_EQ(manager.getStats().residentBytes, TEXTURE_SIZE * 2);
+}
+
+TEST_F(TextureManagerTest, DropsReleasedPendingTexture)
+{
+    auto manager = createManager(TEXTURE_SIZE * 2);
+    auto first   = manager.acquire("first", decodeTestTexture);
+    auto second  = manager.acquire("second", decodeTestTexture);
+    manager.update();
+
+    auto blocked  = manager.acquire("blocked", decodeTestTexture);
+    auto* texture = blocked.get();
+    auto queued   = manager.acquire("queued", decodeTestTexture);
+    manager.update();
+    EXPECT_EQ(blocked->getState(), TextureState::Decoded);
+
+    // Nobody wants these anymore, so they must not be uploaded once the budget frees up
+    manager.release(blocked);
+    manager.release(queued);
+    manager.release(first);
+    manager.update();
+
+    EXPECT_EQ(texture->getState(), TextureState::Unloaded);
+    EXPECT_EQ(manager.getStats().pendingCount, 0);
+    EXPECT_EQ(manager.getStats().loadsThisFrame, 0);
+    EXPECT_EQ(lastId, 2);
+}
+
+TEST_F(TextureManagerTest, DestroysTexturesWithManager)
+{
+    {
+        auto manager = createManager(TEXTURE_SIZE * 2);
+        auto first   = manager.acquire("first", decodeTestTexture);
+        auto second  = manager.acquire("second", decodeTestTexture);
+        manager.update();
+    }
+
+    std::sort(destroyed.begin(), destroyed.end());
+    EXPECT_EQ(destroyed, (std::vector<unsigned int> {1, 2}));
+}
+
+TEST(TextureManager, IsNotCopyable)
+{
+    EXPECT_FALSE(std::is_copy_constructible_v<TextureManager>);
+    EXPECT_FALSE(std::is_copy_assignable_v<TextureManager>);
+}
+
+TEST_F(TextureManagerTest, RejectsTextureLargerThanBudget)
+{
+    auto manager = createManager(TEXTURE_SIZE - 1);
+    auto texture = manager.acquire("texture", decodeTestTexture);
+    manager.update();
+
+    EXPECT_EQ(texture->getState(), TextureState::Failed);
+    EXPECT_EQ(manager.getStats().residentBytes, 0);
+    EXPECT_EQ(manager.getStats().failedCount, 1);
+    EXPECT_EQ(lastId, 0);
+}
+
+TEST_F(TextureManagerTest, CapsLoadsPerFrame)
+{
+    auto manager = createManager(TEXTURE_SIZE * 8, 2);
+    std::vector<TextureHandle> textures;
+    for (int i = 0; i < 5; ++i)
+    {
+        textures.push_back(manager.acquire("texture" + std::to_string(i), decodeTestTexture));
+    }
+
+    manager.update();
+    EXPECT_EQ(manager.getStats().loadsThisFrame, 2);
+    EXPECT_EQ(manager.getStats().pendingCount, 3);
+
+    manager.update();
+    EXPECT_EQ(manager.getStats().loadsThisFrame, 2);
+    EXPECT_EQ(manager.getStats().pendingCount, 1);
+
+    manager.update();
+    EXPECT_EQ(manager.getStats().loadsThisFrame, 1);
+    EXPECT_EQ(manager.getStats().pendingCount, 0);
+    EXPECT_EQ(manager.getStats().residentCount, 5);
+}
+
+TEST_F(TextureManagerTest, RetriesFailedDecode)
+{
+    auto manager   = createManager(TEXTURE_SIZE);
+    bool available = false;
+    auto decoder   = [&available](const std::string& path, TextureImage& outImage)
+    {
+        return available && decodeTestTexture(path, outImage);
+    };
+
+    auto texture = manager.acquire("texture", decoder);
+    manager.update();
+    EXPECT_EQ(texture->getState(), TextureState::Queued);
+
+    for (int i = 0; i < 2000 && texture->getState() != TextureState::Failed; ++i)
+    {
+        manager.update();
+    }
+    EXPECT_EQ(texture->getState(), TextureState::Failed);
+    EXPECT_EQ(manager.getStats().failedCount, 1);
+    EXPECT_FALSE(manager.bind(texture));
+
+    // Acquiring again starts over, e.g. once the file has arrived
+    available = true;
+    manager.acquire("texture", decoder);
+    manager.update();
+    EXPECT_EQ(texture->getState(), TextureState::Resident);
+    EXPECT_EQ(manager.getStats().failedCount, 0);
+}